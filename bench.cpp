@@ -0,0 +1,404 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "matcher.h"
+using namespace cv;
+using namespace std;
+
+// 模板匹配基准测试：脱离ADB，在保存的截图语料上单独测量匹配各阶段耗时
+// 用法：match_bench [-n 重复次数] [-t 每组预算毫秒] [-s 缩放列表] [-o 输出文件] [语料目录] [模板目录]
+// 语料目录放入若干张游戏截图（*.png），可用 auto_click_cli --save-frames 在运行时自动收集到 ./bench_corpus/
+// 模板准备与命中判定直接调用 matcher.h（与主程序同一实现，含掩码目录、缩放与匹配缓存）
+// 结果以JSON输出，便于对比匹配器改动前后的数据
+
+struct BenchConfig {
+    static constexpr const char* CORPUS_DIR = "./bench_corpus/";
+    static constexpr const char* UI_TEMPLATE_DIR = "./ui/";
+    static constexpr const char* MASK_SUBDIR = "mask/";  // 模板目录下的掩码子目录，与主程序一致
+    static constexpr int ITERATIONS = 20;                // 每组样本的默认重复次数；需要看 p90/p99 时用 -n 提高
+    static constexpr int BUDGET_MS = 2000;               // 每组样本的默认时间预算，超出后提前结束（0 表示不限）
+    static constexpr int MIN_SAMPLES = 3;                // 预算耗尽时每组至少保留的样本数
+    static constexpr float FIXED_THRESHOLD = 0.25f;      // 与主程序一致的命中阈值
+};
+
+// 参与测量的匹配方法
+struct MethodInfo {
+    int id;
+    const char* name;
+};
+
+const MethodInfo METHODS[] = {
+    {TM_SQDIFF, "TM_SQDIFF"},
+    {TM_SQDIFF_NORMED, "TM_SQDIFF_NORMED"},
+    {TM_CCORR, "TM_CCORR"},
+    {TM_CCORR_NORMED, "TM_CCORR_NORMED"},
+    {TM_CCOEFF, "TM_CCOEFF"},
+    {TM_CCOEFF_NORMED, "TM_CCOEFF_NORMED"}
+};
+
+// 一组耗时样本（微秒）及其所属分类
+struct Series {
+    string stage;     // decode / prepare / match / minmaxloc / decision
+    string method;
+    string item;      // 模板或截图文件名
+    string frame_size;
+    int hits;         // 仅 decision 阶段有效
+    vector<double> min_vals;  // 仅 decision 阶段有效：按截图顺序记录的最小匹配值
+    vector<double> samples;
+};
+
+// deque 追加元素时不会使已有引用失效
+deque<Series> g_series;
+
+// 每组样本的时间预算（毫秒），由 -t 设置
+int g_budget_ms = BenchConfig::BUDGET_MS;
+
+/**
+ * 查找或新建一组样本
+ */
+Series& series_for(const string& stage, const string& method,
+                   const string& item, const string& frame_size) {
+    for (size_t i = 0; i < g_series.size(); i++) {
+        Series& s = g_series[i];
+        if (s.stage == stage && s.method == method && s.item == item && s.frame_size == frame_size) {
+            return s;
+        }
+    }
+    Series s;
+    s.stage = stage;
+    s.method = method;
+    s.item = item;
+    s.frame_size = frame_size;
+    s.hits = 0;
+    g_series.push_back(s);
+    return g_series.back();
+}
+
+double elapsed_us(const chrono::steady_clock::time_point& start) {
+    return chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * 判断一组测量是否继续：达到重复次数，或已有最少样本且本组耗时超出预算时停止
+ * @param k 已采集的样本数
+ * @param iterations 重复次数上限
+ * @param series_start 本组开始时间
+ */
+bool keep_sampling(int k, int iterations, const chrono::steady_clock::time_point& series_start) {
+    if (k >= iterations) return false;
+    if (k < BenchConfig::MIN_SAMPLES || g_budget_ms <= 0) return true;
+    return elapsed_us(series_start) < g_budget_ms * 1000.0;
+}
+
+/**
+ * 取已排序样本的百分位数（最近秩法）
+ */
+double percentile(const vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    size_t rank = static_cast<size_t>(p / 100.0 * sorted.size() + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > sorted.size()) rank = sorted.size();
+    return sorted[rank - 1];
+}
+
+string base_name(const string& path) {
+    size_t pos = path.find_last_of("/\\");
+    return pos == string::npos ? path : path.substr(pos + 1);
+}
+
+string size_label(const Mat& img) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%dx%d", img.cols, img.rows);
+    return buf;
+}
+
+/**
+ * 输出JSON字符串（转义引号与反斜杠）
+ */
+void write_json_string(FILE* out, const string& text) {
+    fputc('"', out);
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] == '"' || text[i] == '\\') fputc('\\', out);
+        fputc(text[i], out);
+    }
+    fputc('"', out);
+}
+
+void write_json(FILE* out, const string& corpus_dir, const string& template_dir,
+                const vector<string>& frame_names, int iterations) {
+    fprintf(out, "{\n  \"corpus\": ");
+    write_json_string(out, corpus_dir);
+    fprintf(out, ",\n  \"templates\": ");
+    write_json_string(out, template_dir);
+    fprintf(out, ",\n  \"frames\": [");
+    for (size_t i = 0; i < frame_names.size(); i++) {
+        if (i) fprintf(out, ", ");
+        write_json_string(out, frame_names[i]);
+    }
+    fprintf(out, "]");
+    fprintf(out, ",\n  \"iterations\": %d,\n  \"budget_ms\": %d,\n  \"threshold\": %.2f,\n  \"results\": [",
+            iterations, g_budget_ms, BenchConfig::FIXED_THRESHOLD);
+
+    for (size_t i = 0; i < g_series.size(); i++) {
+        const Series& s = g_series[i];
+        vector<double> sorted = s.samples;
+        sort(sorted.begin(), sorted.end());
+        double total = 0.0;
+        for (size_t j = 0; j < sorted.size(); j++) total += sorted[j];
+        double mean = sorted.empty() ? 0.0 : total / sorted.size();
+
+        fprintf(out, "%s\n    {\"stage\": ", i ? "," : "");
+        write_json_string(out, s.stage);
+        fprintf(out, ", \"method\": ");
+        write_json_string(out, s.method);
+        fprintf(out, ", \"item\": ");
+        write_json_string(out, s.item);
+        fprintf(out, ", \"frame_size\": ");
+        write_json_string(out, s.frame_size);
+        fprintf(out, ", \"count\": %lu, \"mean_us\": %.1f, \"p50_us\": %.1f, \"p90_us\": %.1f, "
+                     "\"p99_us\": %.1f, \"max_us\": %.1f, \"ops_per_sec\": %.2f",
+                static_cast<unsigned long>(sorted.size()), mean, percentile(sorted, 50),
+                percentile(sorted, 90), percentile(sorted, 99),
+                sorted.empty() ? 0.0 : sorted.back(), mean > 0.0 ? 1e6 / mean : 0.0);
+        if (s.stage == "decision") {
+            fprintf(out, ", \"hits\": %d, \"min_vals\": [", s.hits);
+            for (size_t j = 0; j < s.min_vals.size(); j++) {
+                fprintf(out, "%s%.4f", j ? ", " : "", s.min_vals[j]);
+            }
+            fprintf(out, "]");
+        }
+        fprintf(out, "}");
+    }
+    fprintf(out, "\n  ]\n}\n");
+}
+
+/**
+ * 测量端到端命中判定：与主程序相同的 match_in_roi（表示转换 + matchTemplate + minMaxLoc）+ 阈值比较
+ * @param cache 为空时每次都完整匹配；传入缓存时首轮未命中，其后测得的是画面不变时的缓存命中开销
+ */
+void measure_decision(Series& series, const Mat& frame, const TemplateEntry& model,
+                      MatchCache* cache, int iterations) {
+    Rect roi(0, 0, frame.cols, frame.rows);
+    chrono::steady_clock::time_point series_start = chrono::steady_clock::now();
+    for (int k = 0; keep_sampling(k, iterations, series_start); k++) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        double min_val;
+        Point min_loc;
+        match_in_roi(frame, roi, model, cache, &min_val, &min_loc);
+        bool hit = min_val <= BenchConfig::FIXED_THRESHOLD;
+        series.samples.push_back(elapsed_us(start));
+        if (k == 0) {
+            series.min_vals.push_back(min_val);
+            if (hit) series.hits++;
+        }
+    }
+}
+
+// 命中判定的对比组合：未使用掩码目录的BGR、主程序当前配置（掩码+BGR）、掩码+单通道
+struct DecisionVariant {
+    const char* name;
+    bool use_mask_dir;
+    MatchMode mode;
+    bool cached;
+};
+
+const DecisionVariant DECISION_VARIANTS[] = {
+    {"TM_SQDIFF_NORMED", false, MODE_BGR, false},
+    {"TM_SQDIFF_NORMED+mask", true, MODE_BGR, false},
+    {"TM_SQDIFF_NORMED+mask+channel", true, MODE_CHANNEL, false},
+    {"TM_SQDIFF_NORMED+mask+cache", true, MODE_BGR, true}
+};
+
+/**
+ * 解析逗号分隔的缩放列表，如 "1,0.75,0.5"
+ */
+vector<double> parse_scales(const char* text) {
+    vector<double> scales;
+    string list(text);
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find(',', start);
+        if (end == string::npos) end = list.size();
+        double scale = atof(list.substr(start, end - start).c_str());
+        if (scale > 0.0) scales.push_back(scale);
+        start = end + 1;
+    }
+    return scales;
+}
+
+void print_usage(const char* prog) {
+    fprintf(stderr, "用法：%s [-n 重复次数] [-t 每组预算毫秒] [-s 缩放列表] [-o 输出文件] [语料目录] [模板目录]\n", prog);
+    fprintf(stderr, "  默认语料目录 %s，模板目录 %s（掩码读取其下的 %s），缩放 1.0，结果输出到标准输出\n",
+            BenchConfig::CORPUS_DIR, BenchConfig::UI_TEMPLATE_DIR, BenchConfig::MASK_SUBDIR);
+    fprintf(stderr, "  每组最多重复 %d 次、耗时超过 %d 毫秒后提前结束（至少 %d 个样本，-t 0 表示不限）\n",
+            BenchConfig::ITERATIONS, BenchConfig::BUDGET_MS, BenchConfig::MIN_SAMPLES);
+}
+
+int main(int argc, char* argv[]) {
+    int iterations = BenchConfig::ITERATIONS;
+    vector<double> scales(1, 1.0);
+    const char* output_path = nullptr;
+    string corpus_dir = BenchConfig::CORPUS_DIR;
+    string template_dir = BenchConfig::UI_TEMPLATE_DIR;
+
+    int positional = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            g_budget_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            scales = parse_scales(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output_path = argv[++i];
+        } else if (argv[i][0] == '-') {
+            print_usage(argv[0]);
+            return 1;
+        } else if (positional == 0) {
+            corpus_dir = argv[i];
+            positional++;
+        } else {
+            template_dir = argv[i];
+            positional++;
+        }
+    }
+    if (iterations < 1 || g_budget_ms < 0 || scales.empty()) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    // 共用加载函数直接拼接目录与文件名
+    char last = template_dir.empty() ? '/' : template_dir[template_dir.size() - 1];
+    if (last != '/' && last != '\\') template_dir += "/";
+    string mask_dir = template_dir + BenchConfig::MASK_SUBDIR;
+
+    vector<String> frame_paths;
+    vector<String> template_paths;
+    glob(corpus_dir + "/*.png", frame_paths, false);
+    glob(template_dir + "/*.png", template_paths, false);
+    if (frame_paths.empty() || template_paths.empty()) {
+        fprintf(stderr, "语料或模板为空：%s（%lu 张），%s（%lu 个）\n",
+                corpus_dir.c_str(), static_cast<unsigned long>(frame_paths.size()),
+                template_dir.c_str(), static_cast<unsigned long>(template_paths.size()));
+        if (frame_paths.empty()) {
+            fprintf(stderr, "可用 auto_click_cli --save-frames 运行一段时间，截图会另存到 %s\n",
+                    BenchConfig::CORPUS_DIR);
+        }
+        return 1;
+    }
+
+    // 解码耗时：截图与模板各自单独统计
+    vector<Mat> frames;
+    vector<string> frame_names;
+    for (size_t i = 0; i < frame_paths.size(); i++) {
+        Mat img;
+        chrono::steady_clock::time_point series_start = chrono::steady_clock::now();
+        for (int k = 0; keep_sampling(k, iterations, series_start); k++) {
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            img = imread(frame_paths[i]);
+            double us = elapsed_us(start);
+            series_for("decode", "", base_name(frame_paths[i]), size_label(img)).samples.push_back(us);
+        }
+        if (img.empty()) {
+            fprintf(stderr, "无法读取截图：%s\n", frame_paths[i].c_str());
+            continue;
+        }
+        frames.push_back(img);
+        frame_names.push_back(base_name(frame_paths[i]));
+    }
+
+    vector<string> template_names;
+    for (size_t i = 0; i < template_paths.size(); i++) {
+        template_names.push_back(base_name(template_paths[i]));
+    }
+
+    const int method_count = sizeof(METHODS) / sizeof(METHODS[0]);
+    const int variant_count = sizeof(DECISION_VARIANTS) / sizeof(DECISION_VARIANTS[0]);
+    for (size_t si = 0; si < scales.size(); si++) {
+        double scale = scales[si];
+        char scale_label[32];
+        snprintf(scale_label, sizeof(scale_label), "scale=%.3f", scale);
+
+        // 模板按主程序的方式准备（读取、缩放、掩码裁剪、表示转换），准备耗时单独统计。
+        // plain 不读掩码目录、不裁剪，用于各匹配方法的对比
+        vector<TemplateEntry> plain(template_names.size());
+        vector<vector<TemplateEntry> > models(template_names.size(), vector<TemplateEntry>(variant_count));
+        vector<bool> prepared(template_names.size(), false);
+        for (size_t ti = 0; ti < template_names.size(); ti++) {
+            const char* name = template_names[ti].c_str();
+            if (!load_scaled_template(template_dir.c_str(), nullptr, name, MODE_BGR, scale, &plain[ti])) continue;
+            for (int vi = 0; vi < variant_count; vi++) {
+                const DecisionVariant& variant = DECISION_VARIANTS[vi];
+                const char* variant_mask_dir = variant.use_mask_dir ? mask_dir.c_str() : nullptr;
+                Series& prepare = series_for("prepare", variant.name, template_names[ti], scale_label);
+                chrono::steady_clock::time_point series_start = chrono::steady_clock::now();
+                for (int k = 0; keep_sampling(k, iterations, series_start); k++) {
+                    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+                    load_scaled_template(template_dir.c_str(), variant_mask_dir, name, variant.mode, scale,
+                                         &models[ti][vi]);
+                    prepare.samples.push_back(elapsed_us(start));
+                }
+            }
+            prepared[ti] = true;
+        }
+
+        for (size_t fi = 0; fi < frames.size(); fi++) {
+            // 截图与模板按同一比例缩放，模拟不同分辨率的设备
+            Mat frame = frames[fi];
+            if (scale != 1.0) resize(frames[fi], frame, Size(), scale, scale, INTER_AREA);
+            string frame_size = size_label(frame);
+            fprintf(stderr, "测量 %s @ %s ...\n", frame_names[fi].c_str(), frame_size.c_str());
+
+            for (size_t ti = 0; ti < template_names.size(); ti++) {
+                if (!prepared[ti]) continue;
+                if (plain[ti].image.cols > frame.cols || plain[ti].image.rows > frame.rows) continue;
+
+                for (int mi = 0; mi < method_count; mi++) {
+                    Series& match = series_for("match", METHODS[mi].name, template_names[ti], frame_size);
+                    Series& locate = series_for("minmaxloc", METHODS[mi].name, template_names[ti], frame_size);
+                    chrono::steady_clock::time_point series_start = chrono::steady_clock::now();
+                    for (int k = 0; keep_sampling(k, iterations, series_start); k++) {
+                        Mat result;
+                        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+                        matchTemplate(frame, plain[ti].image, result, METHODS[mi].id);
+                        match.samples.push_back(elapsed_us(start));
+
+                        double min_val, max_val;
+                        Point min_loc, max_loc;
+                        start = chrono::steady_clock::now();
+                        minMaxLoc(result, &min_val, &max_val, &min_loc, &max_loc);
+                        locate.samples.push_back(elapsed_us(start));
+                    }
+                }
+
+                // 端到端命中判定，与主程序同一条 match_in_roi 路径
+                for (int vi = 0; vi < variant_count; vi++) {
+                    MatchCache cache(1);
+                    measure_decision(series_for("decision", DECISION_VARIANTS[vi].name, template_names[ti], frame_size),
+                                     frame, models[ti][vi], DECISION_VARIANTS[vi].cached ? &cache : nullptr,
+                                     iterations);
+                }
+            }
+        }
+    }
+
+    FILE* out = stdout;
+    if (output_path) {
+        out = fopen(output_path, "w");
+        if (!out) {
+            fprintf(stderr, "无法写入结果文件：%s\n", output_path);
+            return 1;
+        }
+    }
+    write_json(out, corpus_dir, template_dir, frame_names, iterations);
+    if (out != stdout) {
+        fclose(out);
+        fprintf(stderr, "结果已写入：%s\n", output_path);
+    }
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <afunix.h>
+#else
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+// 守护进程控制客户端（与 main.cpp 的 --daemon 模式配合使用）
+// 用法：autoclick_ctl [-s 套接字路径] <命令...>
+// 示例：autoclick_ctl start
+//       autoclick_ctl set threshold 0.3
+//       autoclick_ctl watch 500
+
+#ifdef _WIN32
+typedef SOCKET socket_t;
+#define close_socket closesocket
+#else
+typedef int socket_t;
+#define INVALID_SOCKET (-1)
+#define close_socket close
+#endif
+
+static const char* DEFAULT_SOCKET_PATH = "./autoclick.sock";
+
+void print_usage(const char* prog) {
+    printf("用法：%s [-s 套接字路径] <命令>\n", prog);
+    printf("命令：\n");
+    printf("  start | stop | pause | resume | quit\n");
+    printf("  metrics                      输出一次运行指标\n");
+    printf("  watch <毫秒>                 按间隔持续输出运行指标\n");
+    printf("  set threshold <值>           修改匹配阈值\n");
+    printf("  set click_delay_ms <毫秒>    修改点击间隔\n");
+    printf("  set process_delay_sec <秒>   修改流程间隔\n");
+    printf("  set device <地址>            切换ADB设备\n");
+}
+
+int main(int argc, char* argv[]) {
+    const char* socket_path = DEFAULT_SOCKET_PATH;
+    int first = 1;
+    if (argc > 2 && strcmp(argv[1], "-s") == 0) {
+        socket_path = argv[2];
+        first = 3;
+    }
+    if (first >= argc) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    // 把剩余参数拼成一行命令
+    char command[256] = "";
+    for (int i = first; i < argc; i++) {
+        if (i > first) strncat(command, " ", sizeof(command) - strlen(command) - 1);
+        strncat(command, argv[i], sizeof(command) - strlen(command) - 1);
+    }
+    int streaming = strcmp(argv[first], "watch") == 0;
+    strncat(command, "\n", sizeof(command) - strlen(command) - 1);
+
+#ifdef _WIN32
+    WSADATA wsa_data;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0) {
+        printf("Winsock 初始化失败！\n");
+        return 1;
+    }
+#endif
+
+    socket_t sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock == INVALID_SOCKET) {
+        printf("创建套接字失败！\n");
+        return 1;
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", socket_path);
+    if (connect(sock, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+        printf("无法连接守护进程：%s\n", socket_path);
+        close_socket(sock);
+        return 1;
+    }
+
+    if (send(sock, command, static_cast<int>(strlen(command)), 0) <= 0) {
+        printf("发送命令失败！\n");
+        close_socket(sock);
+        return 1;
+    }
+
+    // 普通命令读取一行应答；watch 持续输出直到连接断开
+    int ret = streaming ? 0 : 1;
+    char buffer[512];
+    int n;
+    while ((n = recv(sock, buffer, sizeof(buffer) - 1, 0)) > 0) {
+        buffer[n] = '\0';
+        fputs(buffer, stdout);
+        fflush(stdout);
+        if (!streaming && strchr(buffer, '\n')) {
+            ret = strncmp(buffer, "error", 5) == 0 ? 1 : 0;
+            break;
+        }
+    }
+
+    close_socket(sock);
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    return ret;
+}
@@ -2,26 +2,189 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <stdint.h>
 #include <sys/stat.h>
+#include <time.h>
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
 #include <opencv2/opencv.hpp>
+#include "matcher.h"
+#ifdef _WIN32
+#define NOMINMAX
+#include <winsock2.h>
+#include <afunix.h>
+#include <direct.h>
+#else
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
 using namespace cv;
 using namespace std;
 
 // 配置参数结构体，集中管理常量
 struct Config {
-    static constexpr const char* DEVICE = "127.0.0.1:16384";
-    static constexpr float FIXED_THRESHOLD = 0.25f;
+    static char DEVICE[64];
+    static float FIXED_THRESHOLD;
     static constexpr const char* SCREENSHOT_PATH = "./screenshot.png";
     static constexpr const char* UI_TEMPLATE_DIR = "./ui/";
+    static constexpr const char* UI_MASK_DIR = "./ui/mask/";  // 可选的同名重要性掩码（白色为参与匹配的像素），默认不提供
     static constexpr int RETRY_ATTEMPTS = 1;  // 重试次数
-    static constexpr int CLICK_DELAY_MS = 500000;  // 点击间隔微秒
-    static constexpr int PROCESS_DELAY_SEC = 5;    // 流程间隔秒数
+    static int CLICK_DELAY_MS;     // 点击间隔微秒
+    static int PROCESS_DELAY_SEC;  // 流程间隔秒数
+    static constexpr int MATCH_CACHE_CAPACITY = 64;  // 匹配结果缓存条目上限
+    static constexpr int MATCH_SEARCH_MARGIN = 64;   // 上次命中位置向外扩展的搜索边距（基准分辨率像素）
+    static constexpr const char* BENCH_CORPUS_DIR = "./bench_corpus/";  // --save-frames 时截图的另存目录（match_bench 默认语料目录）
+    static constexpr int BENCH_CORPUS_MAX_FRAMES = 200;  // 单次运行最多另存的截图数
+    static constexpr int BASE_WIDTH = 2560;   // 模板与坐标采集时的屏幕宽度
+    static constexpr int BASE_HEIGHT = 1440;  // 模板与坐标采集时的屏幕高度
+    static constexpr const char* CONTROL_SOCKET_PATH = "./autoclick.sock";  // 守护模式控制套接字
+    static constexpr int MAX_CLICK_DELAY_MS = 60000;     // 控制接口允许设置的最大点击间隔
+    static constexpr int MAX_PROCESS_DELAY_SEC = 3600;   // 控制接口允许设置的最大流程间隔
+    static constexpr int MAX_WATCH_INTERVAL_MS = 60000;  // watch 推送间隔上限
+    static constexpr int VERIFY_RETRY = 2;            // 点击未生效时的补点次数
+    static constexpr int VERIFY_SETTLE_US = 300000;   // 点击后首次检查前的等待微秒数
+    static constexpr int VERIFY_WINDOW_US = 1500000;  // 单次点击的观察窗口，窗口内区域始终无变化才补点
+    static constexpr int VERIFY_POLL_US = 200000;     // 观察窗口内两次检查的间隔微秒数
+    static constexpr int VERIFY_DOWNSCALE = 4;        // 校验区域的缩小倍数
+    static constexpr double VERIFY_DIFF_THRESHOLD = 4.0;  // 区域平均灰度变化低于此值视为点击未生效
 };
 
+// 可在运行时修改的参数（守护模式下由控制接口更新）
+char Config::DEVICE[64] = "127.0.0.1:16384";
+float Config::FIXED_THRESHOLD = 0.25f;
+int Config::CLICK_DELAY_MS = 500000;
+int Config::PROCESS_DELAY_SEC = 5;
+
 // 全局坐标变量（仅在匹配成功后有效）
 int GLOBAL_X = -1;
 int GLOBAL_Y = -1;
 
+// 最近一次匹配成功时的截图与匹配区域（用于点击后校验）
+Mat g_last_frame;
+Rect g_last_match_rect;
+
+// 基准分辨率（BASE_WIDTH x BASE_HEIGHT）下采集的像素坐标
+struct BasePoint {
+    int x;
+    int y;
+};
+
+// 英雄/兵种释放点
+const BasePoint DEPLOY_POINT = {670, 345};
+
+// 每轮部署阶段的点击序列
+const BasePoint INNER_CLICKS[] = {
+    {670, 345}, {978, 170}, {412, 584}, {1519, 112},
+    {1773, 304}, {1833, 1091}, {737, 1085}
+};
+
+const int INNER_CLICK_COUNT = sizeof(INNER_CLICKS) / sizeof(INNER_CLICKS[0]);
+
+// 映射到当前设备像素的固定点击坐标（每次检测分辨率后刷新）
+Point g_deploy_point;
+int g_inner_clicks[INNER_CLICK_COUNT][2];
+
+// 预加载模板及其匹配表示（MatchMode 见 matcher.h）
+struct TemplateSpec {
+    const char* name;
+    MatchMode mode;
+};
+
+// 启动时需要预加载的模板；全部使用三通道、不带掩码。
+// MODE_CHANNEL 或 UI_MASK_DIR 下的掩码会改变匹配值的分布（带掩码的匹配单次还更慢），
+// 只有在 match_bench 的 decision min_vals 证明该模板在当前阈值下判定不变或更可靠时才逐个启用
+const TemplateSpec TEMPLATE_SPECS[] = {
+    {"cangying.png", MODE_BGR}, {"caoman.png", MODE_BGR}, {"feilong.png", MODE_BGR},
+    {"huiying.png", MODE_BGR}, {"jieshu.png", MODE_BGR}, {"jingong.png", MODE_BGR},
+    {"leidian.png", MODE_BGR}, {"manwang.png", MODE_BGR}, {"nvhuang.png", MODE_BGR},
+    {"queding.png", MODE_BGR}, {"runtu.png", MODE_BGR}, {"sousuo.png", MODE_BGR},
+    {"tianniao.png", MODE_BGR}, {"yongwang.png", MODE_BGR}
+};
+
+// 设备分辨率信息（启动时检测一次）
+struct DeviceProfile {
+    int width;
+    int height;
+    double scale;  // 模板缩放比例：游戏界面随屏幕高度等比缩放，宽高比不同时不拉伸
+};
+
+DeviceProfile g_device = {Config::BASE_WIDTH, Config::BASE_HEIGHT, 1.0};
+
+// 单项耗时统计（微秒）
+struct LatencyStat {
+    std::atomic<unsigned long> count;
+    std::atomic<unsigned long long> total_us;
+    std::atomic<unsigned long long> max_us;
+};
+
+// 运行指标（工作线程写入，控制线程随时读取）
+struct Metrics {
+    std::atomic<unsigned long> rounds_completed;
+    LatencyStat capture;  // 截图 + 解码
+    LatencyStat match;    // 模板匹配（含缓存查询）
+    std::atomic<unsigned long> match_hits;    // 匹配值低于阈值的次数
+    std::atomic<unsigned long> match_misses;
+    std::atomic<unsigned long> click_retries;  // 校验发现点击未生效后的补点次数
+};
+
+Metrics g_metrics;
+
+/**
+ * 记录一次耗时
+ * @param stat 统计项
+ * @param us 耗时（微秒）
+ */
+void record_latency(LatencyStat& stat, unsigned long long us) {
+    stat.count.fetch_add(1, std::memory_order_relaxed);
+    stat.total_us.fetch_add(us, std::memory_order_relaxed);
+    unsigned long long prev = stat.max_us.load(std::memory_order_relaxed);
+    while (us > prev && !stat.max_us.compare_exchange_weak(prev, us, std::memory_order_relaxed)) {
+    }
+}
+
+/**
+ * 计算从指定时刻到现在经过的微秒数
+ */
+unsigned long long elapsed_us(const std::chrono::steady_clock::time_point& start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+// 运行状态（守护模式下由控制接口切换）
+enum RunState {
+    STATE_STOPPED = 0,
+    STATE_RUNNING = 1,
+    STATE_PAUSED = 2
+};
+
+std::atomic<int> g_run_state(STATE_RUNNING);
+std::atomic<bool> g_quit(false);
+bool g_device_ready = false;  // 仅工作线程访问
+bool g_save_frames = false;   // --save-frames：另存每次截图作为基准测试语料
+
+// 待生效的配置修改（控制线程写入，工作线程在检查点应用）
+struct PendingConfig {
+    bool has_threshold;
+    float threshold;
+    bool has_click_delay;
+    int click_delay_us;
+    bool has_process_delay;
+    int process_delay_sec;
+    bool has_device;
+    char device[64];
+};
+
+std::mutex g_config_mutex;
+PendingConfig g_pending_config;
+std::atomic<bool> g_config_dirty(false);
+
 /**
  * @param cmd 要执行的命令
  * @return 0表示成功，-1表示失败
@@ -40,6 +203,57 @@ int execute_command(const char* cmd) {
     return ret == 0 ? 0 : -1;
 }
 
+/**
+ * 执行命令并读取其输出
+ * @param cmd 要执行的命令
+ * @param output 输出缓冲区
+ * @param size 缓冲区大小
+ * @return 0表示成功，-1表示失败
+ */
+int read_command_output(const char* cmd, char* output, size_t size) {
+    if (!cmd || strlen(cmd) == 0 || !output || size == 0) return -1;
+    output[0] = '\0';
+    FILE* pipe = _popen(cmd, "r");
+    if (!pipe) return -1;
+    
+    char buffer[128];
+    size_t used = 0;
+    while (fgets(buffer, sizeof(buffer), pipe)) {
+        size_t len = strlen(buffer);
+        if (used + len >= size) len = size - used - 1;
+        memcpy(output + used, buffer, len);
+        used += len;
+        output[used] = '\0';
+    }
+    
+    int ret = _pclose(pipe);
+    return ret == 0 ? 0 : -1;
+}
+
+/**
+ * 将基准分辨率坐标映射为当前设备的像素坐标
+ * 与模板缩放同一模型：界面按高度比例等比缩放并水平居中，因此取相对屏幕中心的偏移乘以 g_device.scale
+ * @param p 基准分辨率坐标
+ * @return 设备像素坐标
+ */
+Point to_device_point(const BasePoint& p) {
+    double dx = (p.x - Config::BASE_WIDTH / 2.0) * g_device.scale;
+    double dy = (p.y - Config::BASE_HEIGHT / 2.0) * g_device.scale;
+    return Point(cvRound(g_device.width / 2.0 + dx), cvRound(g_device.height / 2.0 + dy));
+}
+
+/**
+ * 按当前设备分辨率刷新固定点击坐标表
+ */
+void map_fixed_points() {
+    g_deploy_point = to_device_point(DEPLOY_POINT);
+    for (int i = 0; i < INNER_CLICK_COUNT; i++) {
+        Point p = to_device_point(INNER_CLICKS[i]);
+        g_inner_clicks[i][0] = p.x;
+        g_inner_clicks[i][1] = p.y;
+    }
+}
+
 /**
  * 通过ADB执行点击操作
  * @param x 点击x坐标
@@ -80,17 +294,6 @@ void adb_swipe(int x1, int y1, int x2, int y2, float duration) {
     }
 }
 
-/**
- * 检查文件是否存在
- * @param path 文件路径
- * @return 1表示存在，0表示不存在
- */
-int file_exists(const char* path) {
-    if (!path) return 0;
-    struct stat buffer;
-    return (stat(path, &buffer) == 0) ? 1 : 0;
-}
-
 /**
  * 检查截图文件是否存在
  * @return 1表示存在，0表示不存在
@@ -105,12 +308,35 @@ int check_screenshot() {
     }
 }
 
+/**
+ * 从PNG文件头读取图像尺寸（无需解码整张图）
+ * @param path 文件路径
+ * @param width 输出宽度
+ * @param height 输出高度
+ * @return 1表示成功，0表示失败
+ */
+int read_png_size(const char* path, int* width, int* height) {
+    FILE* fp = fopen(path, "rb");
+    if (!fp) return 0;
+    unsigned char header[24];
+    size_t n = fread(header, 1, sizeof(header), fp);
+    fclose(fp);
+    
+    static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    if (n != sizeof(header) || memcmp(header, signature, 8) != 0) return 0;
+    
+    // IHDR 块紧跟签名，宽高为大端32位整数
+    *width = (header[16] << 24) | (header[17] << 16) | (header[18] << 8) | header[19];
+    *height = (header[20] << 24) | (header[21] << 16) | (header[22] << 8) | header[23];
+    return (*width > 0 && *height > 0) ? 1 : 0;
+}
+
 /**
  * 执行ADB连接设备并获取截图（单次调用）
  * @return 0表示成功，1表示失败
  */
 int take_screenshot_once() {
-    char adb_screenshot_cmd[200];
+    char adb_screenshot_cmd[512];
     const char* screenshot_name = Config::SCREENSHOT_PATH;
     int ret;
     
@@ -129,6 +355,124 @@ int take_screenshot_once() {
     return 0;
 }
 
+/**
+ * 通过 exec-out 直接读取原始帧缓冲并截取指定区域（不落盘、不经 PNG 编解码，用于点击校验）
+ * @param roi 需要的区域（设备像素坐标）
+ * @param frame_size 期望的整帧尺寸，不一致时视为失败
+ * @param out 输出的 BGR 区域图像
+ * @return 0表示成功，1表示失败
+ */
+int capture_roi_raw(const Rect& roi, const Size& frame_size, Mat& out) {
+    char cmd[256];
+    snprintf(cmd, sizeof(cmd), "adb -s %s exec-out screencap", Config::DEVICE);
+    FILE* pipe = _popen(cmd, "rb");  // 二进制模式，避免换行符被转换
+    if (!pipe) return 1;
+    
+    std::vector<uchar> raw;
+    raw.reserve(static_cast<size_t>(frame_size.width) * frame_size.height * 4 + 16);
+    uchar chunk[65536];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), pipe)) > 0) {
+        raw.insert(raw.end(), chunk, chunk + n);
+    }
+    if (_pclose(pipe) != 0 || raw.size() < 12) return 1;
+    
+    // 头部为宽、高、像素格式（新系统另有4字节色彩空间），其后为 RGBA_8888 像素
+    uint32_t header[3];
+    memcpy(header, raw.data(), sizeof(header));
+    int width = static_cast<int>(header[0]);
+    int height = static_cast<int>(header[1]);
+    size_t pixel_bytes = static_cast<size_t>(width) * height * 4;
+    if (header[2] != 1 || width != frame_size.width || height != frame_size.height ||
+        raw.size() < pixel_bytes + 12) {
+        return 1;
+    }
+    
+    Mat rgba(height, width, CV_8UC4, raw.data() + (raw.size() - pixel_bytes));
+    cvtColor(rgba(roi), out, COLOR_RGBA2BGR);
+    return 0;
+}
+
+/**
+ * 把刚截取的屏幕另存到基准测试语料目录（仅 --save-frames 时调用）
+ * 直接复制PNG文件，不重新编码
+ */
+void save_frame_to_corpus() {
+    static int saved = 0;
+    static long run_id = static_cast<long>(time(nullptr));
+    if (saved >= Config::BENCH_CORPUS_MAX_FRAMES) return;
+    
+#ifdef _WIN32
+    _mkdir(Config::BENCH_CORPUS_DIR);
+#else
+    mkdir(Config::BENCH_CORPUS_DIR, 0755);
+#endif
+    char path[256];
+    snprintf(path, sizeof(path), "%sframe_%ld_%03d.png", Config::BENCH_CORPUS_DIR, run_id, saved);
+    
+    FILE* in = fopen(Config::SCREENSHOT_PATH, "rb");
+    if (!in) return;
+    FILE* out = fopen(path, "wb");
+    if (!out) {
+        fclose(in);
+        printf("无法写入语料截图：%s\n", path);
+        return;
+    }
+    char buffer[65536];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        fwrite(buffer, 1, n, out);
+    }
+    fclose(in);
+    fclose(out);
+    saved++;
+}
+
+MatchCache g_match_cache(Config::MATCH_CACHE_CAPACITY);
+
+std::unordered_map<std::string, TemplateEntry> g_templates;
+
+// 各模板上次命中的位置（裁剪后模板左上角），下次优先在其附近的小区域内匹配
+std::unordered_map<std::string, Point> g_last_hits;
+
+/**
+ * 启动时按设备分辨率预加载全部模板
+ * @return 成功加载的模板数量
+ */
+int load_template_set() {
+    g_templates.clear();
+    g_last_hits.clear();
+    g_match_cache.clear();
+    
+    int count = sizeof(TEMPLATE_SPECS) / sizeof(TEMPLATE_SPECS[0]);
+    int loaded = 0;
+    for (int i = 0; i < count; i++) {
+        TemplateEntry entry;
+        if (load_scaled_template(Config::UI_TEMPLATE_DIR, Config::UI_MASK_DIR, TEMPLATE_SPECS[i].name,
+                                 TEMPLATE_SPECS[i].mode, g_device.scale, &entry)) {
+            g_templates[TEMPLATE_SPECS[i].name] = entry;
+            loaded++;
+        }
+    }
+    printf("已预加载模板 %d/%d（缩放 %.3f）\n", loaded, count, g_device.scale);
+    return loaded;
+}
+
+/**
+ * 查找已缩放的模板，不在预加载列表中的模板首次使用时加载
+ * @param name 模板文件名
+ * @return 模板指针，失败返回nullptr
+ */
+const TemplateEntry* find_template(const char* name) {
+    std::unordered_map<std::string, TemplateEntry>::iterator it = g_templates.find(name);
+    if (it != g_templates.end()) return &it->second;
+    
+    TemplateEntry entry;
+    if (!load_scaled_template(Config::UI_TEMPLATE_DIR, Config::UI_MASK_DIR, name,
+                              MODE_BGR, g_device.scale, &entry)) return nullptr;
+    return &(g_templates[name] = entry);
+}
+
 /**
  * 模板匹配（支持重试机制，每次匹配前刷新截图）
  * @param img_model_path 模板图片文件名
@@ -136,31 +480,21 @@ int take_screenshot_once() {
  */
 int match_template(const char* img_model_path) {
     if (!img_model_path) return 0;
-    char full_model_path[256];
-    snprintf(full_model_path, sizeof(full_model_path), 
-             "%s%s", Config::UI_TEMPLATE_DIR, img_model_path);
     
-    // 检查模板文件是否存在
-    if (!file_exists(full_model_path)) {
-        printf("模板文件不存在：%s\n", full_model_path);
+    // 取已按设备分辨率缩放好的模板
+    const TemplateEntry* model = find_template(img_model_path);
+    if (!model) {
         GLOBAL_X = -1;
         GLOBAL_Y = -1;
         return 0;
     }
     
-    // 读取模板
-    Mat img_model = imread(full_model_path);
-    if (img_model.empty()) {
-        printf("无法读取模板：%s\n", full_model_path);
-        GLOBAL_X = -1;
-        GLOBAL_Y = -1;
-        return 0;
-    }
-    
-    int model_h = img_model.rows;
-    int model_w = img_model.cols;
+    int model_h = model->full_size.height;
+    int model_w = model->full_size.width;
     
     for (int attempt = 0; attempt <= Config::RETRY_ATTEMPTS; attempt++) {
+        std::chrono::steady_clock::time_point capture_start = std::chrono::steady_clock::now();
+        
         // 每次匹配前先刷新截图
         if (take_screenshot_once() != 0) {
             printf("截图刷新失败（尝试 %d/%d）\n", attempt + 1, Config::RETRY_ATTEMPTS + 1);
@@ -181,20 +515,52 @@ int match_template(const char* img_model_path) {
             usleep(Config::CLICK_DELAY_MS);
             continue;
         }
+        record_latency(g_metrics.capture, elapsed_us(capture_start));
+        if (g_save_frames) save_frame_to_corpus();
+        
+        if (img.cols != g_device.width || img.rows != g_device.height) {
+            printf("警告：截图尺寸 %dx%d 与设备分辨率 %dx%d 不一致\n",
+                   img.cols, img.rows, g_device.width, g_device.height);
+        }
         
-        Mat result;
-        matchTemplate(img, img_model, result, TM_SQDIFF_NORMED);
-        double min_val;
+        double min_val = 1.0;
         Point min_loc;
-        minMaxLoc(result, &min_val, nullptr, &min_loc, nullptr);
+        std::chrono::steady_clock::time_point match_start = std::chrono::steady_clock::now();
+        
+        // 先在上次命中位置附近的小区域内匹配：只有该区域参与哈希，画面其他位置的动画不影响缓存命中
+        std::unordered_map<std::string, Point>::iterator last = g_last_hits.find(img_model_path);
+        bool found_near = false;
+        if (last != g_last_hits.end()) {
+            int margin = cvRound(Config::MATCH_SEARCH_MARGIN * g_device.scale);
+            Rect near_roi = Rect(last->second.x - margin, last->second.y - margin,
+                                 model->image.cols + 2 * margin, model->image.rows + 2 * margin) &
+                            Rect(0, 0, img.cols, img.rows);
+            if (near_roi.width >= model->image.cols && near_roi.height >= model->image.rows) {
+                match_in_roi(img, near_roi, *model, &g_match_cache, &min_val, &min_loc);
+                found_near = min_val <= Config::FIXED_THRESHOLD;
+            }
+        }
+        // 未命中时回退到整帧搜索；整帧内容几乎每次都变，不经过缓存以免白算哈希
+        if (!found_near) {
+            match_in_roi(img, Rect(0, 0, img.cols, img.rows), *model, nullptr, &min_val, &min_loc);
+            if (min_val <= Config::FIXED_THRESHOLD) g_last_hits[img_model_path] = min_loc;
+        }
+        // 换算回裁剪前模板的左上角
+        min_loc.x -= model->offset.x;
+        min_loc.y -= model->offset.y;
+        record_latency(g_metrics.match, elapsed_us(match_start));
         
         if (min_val <= Config::FIXED_THRESHOLD) {
+            g_metrics.match_hits.fetch_add(1, std::memory_order_relaxed);
+            g_last_frame = img;
+            g_last_match_rect = Rect(min_loc.x, min_loc.y, model_w, model_h);
             GLOBAL_X = min_loc.x + model_w / 2;  // 计算中心坐标
             GLOBAL_Y = min_loc.y + model_h / 2;
             printf("%s 匹配成功（尝试 %d）：坐标 (%d, %d)，匹配值 %.4f\n",
                    img_model_path, attempt + 1, GLOBAL_X, GLOBAL_Y, min_val);
             return 1;
         } else {
+            g_metrics.match_misses.fetch_add(1, std::memory_order_relaxed);
             printf("%s 匹配失败（尝试 %d）：匹配值 %.4f > 阈值 %.2f\n",
                    img_model_path, attempt + 1, min_val, Config::FIXED_THRESHOLD);
             if (attempt < Config::RETRY_ATTEMPTS) {
@@ -209,6 +575,68 @@ int match_template(const char* img_model_path) {
     return 0;
 }
 
+/**
+ * 提取区域的缩小灰度图，作为点击前后比对的特征
+ * @param frame 截图
+ * @param roi 区域
+ * @return 缩小后的灰度图
+ */
+Mat roi_signature(const Mat& frame, const Rect& roi) {
+    Mat gray;
+    Mat small;
+    cvtColor(frame(roi), gray, COLOR_BGR2GRAY);
+    Size size(roi.width / Config::VERIFY_DOWNSCALE, roi.height / Config::VERIFY_DOWNSCALE);
+    if (size.width < 1) size.width = 1;
+    if (size.height < 1) size.height = 1;
+    resize(gray, small, size, 0, 0, INTER_AREA);
+    return small;
+}
+
+/**
+ * 点击最近匹配到的元素，并比对点击前后该区域是否变化，观察窗口内始终无变化才补点
+ * @param x 点击x坐标
+ * @param y 点击y坐标
+ * @return 1表示已确认点击生效，0表示无法校验或多次补点后区域仍无变化
+ */
+int click_and_verify(int x, int y) {
+    Rect roi = g_last_match_rect & Rect(0, 0, g_last_frame.cols, g_last_frame.rows);
+    if (g_last_frame.empty() || roi.area() == 0) {
+        adb_click(x, y);
+        return 0;
+    }
+    
+    Mat before = roi_signature(g_last_frame, roi);
+    for (int attempt = 0; attempt <= Config::VERIFY_RETRY; attempt++) {
+        if (attempt > 0) {
+            g_metrics.click_retries.fetch_add(1, std::memory_order_relaxed);
+            printf("点击后区域无变化，重新点击（%d/%d）\n", attempt, Config::VERIFY_RETRY);
+        }
+        adb_click(x, y);
+        std::chrono::steady_clock::time_point tap_time = std::chrono::steady_clock::now();
+        usleep(Config::VERIFY_SETTLE_US);
+        
+        // 在观察窗口内多次检查，响应较慢的界面不会被误判为点击未生效而重复点击
+        while (true) {
+            // 只取匹配区域；截图失败时无法校验，交给后续匹配兜底
+            Mat after;
+            if (capture_roi_raw(roi, g_last_frame.size(), after) != 0) return 0;
+            
+            Mat diff;
+            absdiff(before, roi_signature(after, Rect(0, 0, roi.width, roi.height)), diff);
+            double change = mean(diff)[0];
+            if (change >= Config::VERIFY_DIFF_THRESHOLD) {
+                printf("点击已生效（区域变化 %.1f）\n", change);
+                return 1;
+            }
+            if (elapsed_us(tap_time) + Config::VERIFY_POLL_US > Config::VERIFY_WINDOW_US) break;
+            usleep(Config::VERIFY_POLL_US);
+        }
+    }
+    
+    printf("多次点击后区域仍无变化：(%d, %d)\n", x, y);
+    return 0;
+}
+
 /**
  * 处理模板列表
  * @param templates 模板文件名数组
@@ -227,7 +655,7 @@ void process_templates(const char* templates[], int count, int click_after_match
         
         if (click_after_match && found && GLOBAL_X != -1 && GLOBAL_Y != -1) {
             printf("准备点击坐标：(%d, %d)\n", GLOBAL_X, GLOBAL_Y);
-            adb_click(GLOBAL_X, GLOBAL_Y);
+            click_and_verify(GLOBAL_X, GLOBAL_Y);
             sleep(1);
         } else if (!found) {
             printf("跳过 %s 点击（无有效坐标）\n", template_name);
@@ -321,18 +749,144 @@ int init_device_connection() {
     return 0;
 }
 
-void main_loop() {
-    const int inner_clicks[7][2] = {
-        {670, 345}, {978, 170}, {412, 584}, {1519, 112},
-        {1773, 304}, {1833, 1091}, {737, 1085}
-    };
-    const int click_count = sizeof(inner_clicks) / sizeof(inner_clicks[0]);
+/**
+ * 检测设备屏幕分辨率（优先 wm size，失败时读取截图文件头）
+ * @return 0表示成功，1表示失败
+ */
+int init_device_profile() {
+    char cmd[256];
+    char output[256];
+    int width = 0;
+    int height = 0;
+    
+    snprintf(cmd, sizeof(cmd), "adb -s %s shell wm size", Config::DEVICE);
+    if (read_command_output(cmd, output, sizeof(output)) == 0) {
+        // 存在 Override size 时以其为准
+        const char* line = strstr(output, "Override size:");
+        if (!line) line = strstr(output, "Physical size:");
+        if (line) {
+            line = strchr(line, ':') + 1;
+            if (sscanf(line, "%dx%d", &width, &height) != 2) {
+                width = 0;
+                height = 0;
+            }
+        }
+    }
+    
+    if (width <= 0 || height <= 0) {
+        printf("wm size 获取失败，改用截图尺寸\n");
+        if (take_screenshot_once() != 0 ||
+            !read_png_size(Config::SCREENSHOT_PATH, &width, &height)) {
+            printf("无法获取屏幕分辨率！\n");
+            return 1;
+        }
+    }
+    
+    // 游戏为横屏，wm size 可能按竖屏报告
+    if (height > width) {
+        int tmp = width;
+        width = height;
+        height = tmp;
+    }
+    
+    g_device.width = width;
+    g_device.height = height;
+    g_device.scale = static_cast<double>(height) / Config::BASE_HEIGHT;
+    map_fixed_points();
+    printf("屏幕分辨率：%dx%d（基准 %dx%d）\n",
+           width, height, Config::BASE_WIDTH, Config::BASE_HEIGHT);
+    return 0;
+}
+
+/**
+ * 连接设备、检测分辨率并预加载模板
+ * @return 0表示成功，1表示失败
+ */
+int prepare_device() {
+    if (init_device_connection() != 0 || init_device_profile() != 0) return 1;
+    load_template_set();
+    g_device_ready = true;
+    return 0;
+}
+
+/**
+ * 应用控制接口提交的配置修改（仅在工作线程的检查点调用）
+ */
+void apply_pending_config() {
+    if (!g_config_dirty.load(std::memory_order_acquire)) return;
+    
+    PendingConfig pending;
+    {
+        std::lock_guard<std::mutex> lock(g_config_mutex);
+        pending = g_pending_config;
+        memset(&g_pending_config, 0, sizeof(g_pending_config));
+        g_config_dirty.store(false, std::memory_order_release);
+    }
     
+    if (pending.has_threshold) {
+        Config::FIXED_THRESHOLD = pending.threshold;
+        printf("配置更新：匹配阈值 %.2f\n", Config::FIXED_THRESHOLD);
+    }
+    if (pending.has_click_delay) {
+        Config::CLICK_DELAY_MS = pending.click_delay_us;
+        printf("配置更新：点击间隔 %d 微秒\n", Config::CLICK_DELAY_MS);
+    }
+    if (pending.has_process_delay) {
+        Config::PROCESS_DELAY_SEC = pending.process_delay_sec;
+        printf("配置更新：流程间隔 %d 秒\n", Config::PROCESS_DELAY_SEC);
+    }
+    if (pending.has_device && strcmp(pending.device, Config::DEVICE) != 0) {
+        snprintf(Config::DEVICE, sizeof(Config::DEVICE), "%s", pending.device);
+        printf("配置更新：设备 %s\n", Config::DEVICE);
+        g_device_ready = false;  // 下一检查点重新连接
+    }
+}
+
+/**
+ * 工作循环检查点：处理暂停、应用配置修改、按需重新连接设备
+ * @return 1表示继续运行，0表示应停止
+ */
+int control_checkpoint() {
+    if (g_run_state.load() == STATE_PAUSED) {
+        printf("任务已暂停\n");
+        while (g_run_state.load() == STATE_PAUSED) {
+            usleep(100000);
+        }
+    }
+    
+    apply_pending_config();
+    if (!g_device_ready && g_run_state.load() == STATE_RUNNING && prepare_device() != 0) {
+        printf("设备不可用，任务已停止\n");
+        g_run_state.store(STATE_STOPPED);
+    }
+    return g_run_state.load() == STATE_RUNNING ? 1 : 0;
+}
+
+/**
+ * 可被停止命令打断的等待（控制台模式下等同于 sleep）
+ * @param seconds 等待秒数
+ * @return 1表示等待完成，0表示收到停止命令
+ */
+int control_sleep(int seconds) {
+    for (long i = 0; i < static_cast<long>(seconds) * 10; i++) {
+        if (g_run_state.load() == STATE_STOPPED) return 0;
+        usleep(100000);
+    }
+    return g_run_state.load() == STATE_STOPPED ? 0 : 1;
+}
+
+/**
+ * 主循环
+ * @return 1表示全部轮次执行完毕，0表示被中途停止
+ */
+int main_loop() {
+    // 固定坐标使用 init_device_profile() 映射好的全局表，检查点切换设备后自动生效
     for (int i = 0; i < 999; i++) {
+        if (!control_checkpoint()) return 0;
         printf("\n===== 主循环第 %d 轮 =====\n", i + 1);
         
         process_matching();
-        sleep(Config::PROCESS_DELAY_SEC);
+        if (!control_sleep(Config::PROCESS_DELAY_SEC)) return 0;
         
         process_thunder();
         int bird_found = process_bird();
@@ -346,43 +900,418 @@ void main_loop() {
             printf("未找到天鸟，跳过点击\n");
         }
         
+        if (!control_checkpoint()) return 0;
         process_queen();
-        adb_click(670, 345);
+        adb_click(g_deploy_point.x, g_deploy_point.y);
         sleep(1);
         process_fullking();
-        adb_click(670, 345);
+        adb_click(g_deploy_point.x, g_deploy_point.y);
         sleep(1);
         process_braveking();
-        adb_click(670, 345);
+        adb_click(g_deploy_point.x, g_deploy_point.y);
         sleep(1);
         process_soiltu();
-        adb_click(670, 345);
+        adb_click(g_deploy_point.x, g_deploy_point.y);
         sleep(1);
         process_eagle();
-        adb_click(670, 345);
+        adb_click(g_deploy_point.x, g_deploy_point.y);
         sleep(1);
         
         for (int j = 0; j < 8; j++) {
+            if (!control_checkpoint()) return 0;
             process_grassman();
             process_dragon();
             
-            execute_click_sequence(inner_clicks, click_count);
+            execute_click_sequence(g_inner_clicks, INNER_CLICK_COUNT);
             printf("第 %d/8 次点击序列完成\n", j + 1);
             usleep(Config::CLICK_DELAY_MS);
         }
         
-        sleep(30);
+        if (!control_sleep(30) || !control_checkpoint()) return 0;
         process_gohome();
-        sleep(Config::PROCESS_DELAY_SEC);
+        g_metrics.rounds_completed.fetch_add(1, std::memory_order_relaxed);
+        g_match_cache.print_stats();
+        if (!control_sleep(Config::PROCESS_DELAY_SEC)) return 0;
+    }
+    return 1;
+}
+
+#ifdef _WIN32
+typedef SOCKET socket_t;
+#define close_socket closesocket
+#define SHUTDOWN_BOTH SD_BOTH
+#else
+typedef int socket_t;
+#define INVALID_SOCKET (-1)
+#define close_socket close
+#define SHUTDOWN_BOTH SHUT_RDWR
+#endif
+
+// 控制连接；线程与套接字由 run_daemon 统一回收，退出前全部 join
+struct ClientConn {
+    socket_t sock;
+    std::thread thread;
+    std::atomic<bool> done;
+};
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+/**
+ * 格式化当前运行指标为单行 key=value 文本
+ * @param buffer 输出缓冲区
+ * @param size 缓冲区大小
+ */
+void format_metrics(char* buffer, size_t size) {
+    static const char* state_names[] = {"stopped", "running", "paused"};
+    const LatencyStat& cap = g_metrics.capture;
+    const LatencyStat& mat = g_metrics.match;
+    unsigned long cap_count = cap.count.load(std::memory_order_relaxed);
+    unsigned long mat_count = mat.count.load(std::memory_order_relaxed);
+    unsigned long hits = g_metrics.match_hits.load(std::memory_order_relaxed);
+    unsigned long misses = g_metrics.match_misses.load(std::memory_order_relaxed);
+    
+    snprintf(buffer, size,
+             "state=%s rounds=%lu "
+             "capture_count=%lu capture_avg_us=%llu capture_max_us=%llu "
+             "match_count=%lu match_avg_us=%llu match_max_us=%llu "
+             "match_hits=%lu match_misses=%lu match_hit_rate=%.3f "
+             "cache_hits=%lu cache_misses=%lu click_retries=%lu",
+             state_names[g_run_state.load()],
+             g_metrics.rounds_completed.load(std::memory_order_relaxed),
+             cap_count, cap_count ? cap.total_us.load(std::memory_order_relaxed) / cap_count : 0ULL,
+             cap.max_us.load(std::memory_order_relaxed),
+             mat_count, mat_count ? mat.total_us.load(std::memory_order_relaxed) / mat_count : 0ULL,
+             mat.max_us.load(std::memory_order_relaxed),
+             hits, misses, (hits + misses) ? static_cast<double>(hits) / (hits + misses) : 0.0,
+             g_match_cache.hits(), g_match_cache.misses(),
+             g_metrics.click_retries.load(std::memory_order_relaxed));
+}
+
+/**
+ * 解析完整的十进制整数并检查范围
+ * @param text 文本
+ * @param min_val 最小值
+ * @param max_val 最大值
+ * @param out 输出值
+ * @return 1表示有效，0表示格式错误或越界
+ */
+int parse_int_in_range(const char* text, long min_val, long max_val, int* out) {
+    char* end = nullptr;
+    long v = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || v < min_val || v > max_val) return 0;
+    *out = static_cast<int>(v);
+    return 1;
+}
+
+/**
+ * 检查设备地址只含序列号或 host:port 允许的字符（[A-Za-z0-9._:-]），
+ * 该值会拼进 adb 的 shell 命令，其他字符一律拒绝以防命令注入
+ * @param device 设备地址
+ * @return 1表示有效，0表示无效
+ */
+int is_valid_device(const char* device) {
+    if (!device || device[0] == '\0') return 0;
+    for (const char* p = device; *p; p++) {
+        char c = *p;
+        bool ok = (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ||
+                  c == '.' || c == '_' || c == ':' || c == '-';
+        if (!ok) return 0;
+    }
+    return 1;
+}
+
+/**
+ * 执行一条控制命令
+ * 支持：start / stop / pause / resume / metrics / quit /
+ *       set threshold <值> / set click_delay_ms <毫秒> / set process_delay_sec <秒> / set device <地址>
+ * @param line 命令行
+ * @param reply 输出应答
+ * @param size 应答缓冲区大小
+ */
+void handle_command(const char* line, char* reply, size_t size) {
+    char cmd[32] = "";
+    char key[32] = "";
+    char value[64] = "";
+    sscanf(line, "%31s %31s %63s", cmd, key, value);
+    
+    if (strcmp(cmd, "start") == 0) {
+        int expected = STATE_STOPPED;
+        snprintf(reply, size, "%s", g_run_state.compare_exchange_strong(expected, STATE_RUNNING) ?
+                 "ok" : "error 任务已在运行");
+    } else if (strcmp(cmd, "stop") == 0) {
+        g_run_state.store(STATE_STOPPED);
+        snprintf(reply, size, "ok");
+    } else if (strcmp(cmd, "pause") == 0) {
+        int expected = STATE_RUNNING;
+        snprintf(reply, size, "%s", g_run_state.compare_exchange_strong(expected, STATE_PAUSED) ?
+                 "ok" : "error 任务未在运行");
+    } else if (strcmp(cmd, "resume") == 0) {
+        int expected = STATE_PAUSED;
+        snprintf(reply, size, "%s", g_run_state.compare_exchange_strong(expected, STATE_RUNNING) ?
+                 "ok" : "error 任务未暂停");
+    } else if (strcmp(cmd, "metrics") == 0) {
+        format_metrics(reply, size);
+    } else if (strcmp(cmd, "quit") == 0) {
+        g_run_state.store(STATE_STOPPED);
+        g_quit.store(true);
+        snprintf(reply, size, "ok");
+    } else if (strcmp(cmd, "set") == 0 && value[0] != '\0') {
+        std::lock_guard<std::mutex> lock(g_config_mutex);
+        int number;
+        if (strcmp(key, "threshold") == 0 && atof(value) > 0.0 && atof(value) <= 1.0) {
+            g_pending_config.has_threshold = true;
+            g_pending_config.threshold = static_cast<float>(atof(value));
+        } else if (strcmp(key, "click_delay_ms") == 0 &&
+                   parse_int_in_range(value, 1, Config::MAX_CLICK_DELAY_MS, &number)) {
+            g_pending_config.has_click_delay = true;
+            g_pending_config.click_delay_us = number * 1000;  // 转微秒
+        } else if (strcmp(key, "process_delay_sec") == 0 &&
+                   parse_int_in_range(value, 0, Config::MAX_PROCESS_DELAY_SEC, &number)) {
+            g_pending_config.has_process_delay = true;
+            g_pending_config.process_delay_sec = number;
+        } else if (strcmp(key, "device") == 0 && is_valid_device(value)) {
+            g_pending_config.has_device = true;
+            snprintf(g_pending_config.device, sizeof(g_pending_config.device), "%s", value);
+        } else {
+            snprintf(reply, size, "error 无效配置：%s %s", key, value);
+            return;
+        }
+        g_config_dirty.store(true, std::memory_order_release);
+        snprintf(reply, size, "ok");
+    } else {
+        snprintf(reply, size, "error 未知命令：%s", line);
+    }
+}
+
+/**
+ * 发送一行文本（自动追加换行）
+ * @return 1表示成功，0表示连接已断开
+ */
+int send_line(socket_t client, const char* text) {
+    char line[600];
+    int len = snprintf(line, sizeof(line), "%s\n", text);
+    if (len < 0) return 0;
+    if (len >= static_cast<int>(sizeof(line))) len = sizeof(line) - 1;
+    
+    int sent = 0;
+    while (sent < len) {
+        int n = send(client, line + sent, len - sent, MSG_NOSIGNAL);
+        if (n <= 0) return 0;
+        sent += n;
+    }
+    return 1;
+}
+
+/**
+ * 处理单个控制连接：逐行读取命令并应答
+ * "watch <毫秒>" 会按间隔持续推送指标，直到客户端断开或守护进程退出
+ * @param conn 连接（返回前置 done，套接字由调用方关闭）
+ */
+void handle_client(ClientConn* conn) {
+    socket_t client = conn->sock;
+    char buffer[512];
+    char reply[512];
+    size_t used = 0;
+    
+    while (!g_quit.load()) {
+        int n = recv(client, buffer + used, static_cast<int>(sizeof(buffer) - used - 1), 0);
+        if (n <= 0) break;
+        used += n;
+        buffer[used] = '\0';
+        
+        char* line = buffer;
+        char* newline;
+        while ((newline = strchr(line, '\n')) != nullptr) {
+            *newline = '\0';
+            if (newline > line && newline[-1] == '\r') newline[-1] = '\0';
+            
+            int interval_ms;
+            if (sscanf(line, "watch %d", &interval_ms) == 1) {
+                if (interval_ms < 10) interval_ms = 10;
+                if (interval_ms > Config::MAX_WATCH_INTERVAL_MS) interval_ms = Config::MAX_WATCH_INTERVAL_MS;
+                while (!g_quit.load()) {
+                    format_metrics(reply, sizeof(reply));
+                    if (!send_line(client, reply)) break;
+                    // 分段等待，退出时不必等满一个间隔
+                    for (int waited = 0; waited < interval_ms && !g_quit.load(); waited += 100) {
+                        int slice = interval_ms - waited < 100 ? interval_ms - waited : 100;
+                        std::this_thread::sleep_for(std::chrono::milliseconds(slice));
+                    }
+                }
+                conn->done.store(true);
+                return;
+            }
+            
+            handle_command(line, reply, sizeof(reply));
+            if (!send_line(client, reply)) {
+                conn->done.store(true);
+                return;
+            }
+            line = newline + 1;
+        }
+        
+        // 保留尚未收完的半行
+        used = strlen(line);
+        memmove(buffer, line, used + 1);
+        if (used >= sizeof(buffer) - 1) break;  // 单行过长
+    }
+    conn->done.store(true);
+}
+
+/**
+ * 回收控制连接
+ * @param clients 连接列表
+ * @param all 为真时关闭全部连接（唤醒阻塞在 recv 的线程），否则只回收已结束的连接
+ */
+void reap_clients(std::list<ClientConn>& clients, bool all) {
+    std::list<ClientConn>::iterator it = clients.begin();
+    while (it != clients.end()) {
+        if (all) shutdown(it->sock, SHUTDOWN_BOTH);
+        if (all || it->done.load()) {
+            it->thread.join();
+            close_socket(it->sock);
+            it = clients.erase(it);
+        } else {
+            ++it;
+        }
     }
 }
 
-int main() {
+/**
+ * 判断路径是否为套接字文件，避免误删同名的普通文件
+ */
+int is_socket_file(const char* path) {
+#ifdef _WIN32
+    // Windows 的 AF_UNIX 套接字文件以重解析点形式存在
+    DWORD attrs = GetFileAttributesA(path);
+    return (attrs != INVALID_FILE_ATTRIBUTES && (attrs & FILE_ATTRIBUTE_REPARSE_POINT)) ? 1 : 0;
+#else
+    struct stat st;
+    return (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) ? 1 : 0;
+#endif
+}
+
+/**
+ * 守护模式工作线程：等待 start 命令后执行主循环
+ */
+void daemon_worker() {
+    while (!g_quit.load()) {
+        if (g_run_state.load() == STATE_STOPPED) {
+            usleep(100000);
+            continue;
+        }
+        if (main_loop()) {
+            // 全部轮次执行完毕后回到停止状态
+            int expected = STATE_RUNNING;
+            g_run_state.compare_exchange_strong(expected, STATE_STOPPED);
+        }
+        printf("任务已停止\n");
+    }
+}
+
+/**
+ * 无界面守护模式：在本地套接字上提供控制与指标接口
+ * @param socket_path 控制套接字路径
+ * @return 0表示正常退出，1表示启动失败
+ */
+int run_daemon(const char* socket_path) {
+#ifdef _WIN32
+    WSADATA wsa_data;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0) {
+        printf("Winsock 初始化失败！\n");
+        return 1;
+    }
+#endif
+    
+    socket_t listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener == INVALID_SOCKET) {
+        printf("创建控制套接字失败！\n");
+        return 1;
+    }
+    
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", socket_path);
+    
+    // 只清理上次残留的套接字文件，其他已存在的路径拒绝覆盖
+    if (is_socket_file(socket_path)) {
+        remove(socket_path);
+    } else if (file_exists(socket_path)) {
+        printf("路径已存在且不是套接字：%s\n", socket_path);
+        close_socket(listener);
+        return 1;
+    }
+    
+    if (bind(listener, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        listen(listener, 8) != 0) {
+        printf("绑定控制套接字失败：%s\n", socket_path);
+        close_socket(listener);
+        return 1;
+    }
+    printf("守护模式已启动，控制套接字：%s\n", socket_path);
+    
+    g_run_state.store(STATE_STOPPED);
+    std::thread worker(daemon_worker);
+    std::list<ClientConn> clients;
+    
+    while (!g_quit.load()) {
+        reap_clients(clients, false);
+        
+        // 带超时等待连接，以便及时响应 quit
+        fd_set fds;
+        FD_ZERO(&fds);
+        FD_SET(listener, &fds);
+        struct timeval timeout = {0, 200000};
+        if (select(static_cast<int>(listener) + 1, &fds, nullptr, nullptr, &timeout) <= 0) continue;
+        
+        socket_t client = accept(listener, nullptr, nullptr);
+        if (client == INVALID_SOCKET) continue;
+        clients.emplace_back();
+        ClientConn& conn = clients.back();
+        conn.sock = client;
+        conn.done.store(false);
+        conn.thread = std::thread(handle_client, &conn);
+    }
+    
+    close_socket(listener);
+    if (is_socket_file(socket_path)) remove(socket_path);
+    reap_clients(clients, true);
+    worker.join();
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    printf("守护进程已退出\n");
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    // --save-frames：把每次匹配用的截图另存到 bench_corpus/，供 match_bench 使用
+    int first = 1;
+    if (argc > first && strcmp(argv[first], "--save-frames") == 0) {
+        g_save_frames = true;
+        first++;
+    }
+    
+    // --daemon [套接字路径]：无界面运行，由控制接口启停
+    if (argc > first && strcmp(argv[first], "--daemon") == 0) {
+        return run_daemon(argc > first + 1 ? argv[first + 1] : Config::CONTROL_SOCKET_PATH);
+    }
+    
     if (init_device_connection() != 0) {
         printf("错误：设备连接失败，程序将退出\n");
         return 1;
     }
     
+    if (init_device_profile() != 0) {
+        printf("错误：无法检测屏幕分辨率，程序将退出\n");
+        return 1;
+    }
+    load_template_set();
+    g_device_ready = true;
+    
     main_loop();
     
     printf("\n所有操作执行完毕\n");
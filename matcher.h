@@ -0,0 +1,357 @@
+#ifndef AUTOCLICK_MATCHER_H
+#define AUTOCLICK_MATCHER_H
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <atomic>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <opencv2/opencv.hpp>
+
+// 模板准备与匹配（主程序 main.cpp 与基准测试 bench.cpp 共用，保证测量的就是实际运行的匹配路径）
+
+/**
+ * 检查文件是否存在
+ * @param path 文件路径
+ * @return 1表示存在，0表示不存在
+ */
+inline int file_exists(const char* path) {
+    if (!path) return 0;
+    struct stat buffer;
+    return (stat(path, &buffer) == 0) ? 1 : 0;
+}
+
+/**
+ * 64位混合函数（MurmurHash3 fmix64），输入的任一位变化都会扩散到输出的全部位
+ */
+inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDULL;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+/**
+ * 计算图像区域的内容哈希（按8字节分块，每块经 mix64 充分混合后再串联）
+ * @param img 图像
+ * @param roi 参与哈希的区域
+ * @return 64位哈希值
+ */
+inline uint64_t hash_mat_region(const cv::Mat& img, const cv::Rect& roi) {
+    uint64_t hash = 0x9E3779B97F4A7C15ULL;
+    hash = mix64(hash ^ static_cast<uint64_t>(img.type()));
+    hash = mix64(hash ^ static_cast<uint64_t>(roi.width));
+    hash = mix64(hash ^ static_cast<uint64_t>(roi.height));
+
+    size_t row_bytes = roi.width * img.elemSize();
+    for (int y = roi.y; y < roi.y + roi.height; y++) {
+        const unsigned char* row = img.ptr<unsigned char>(y) + roi.x * img.elemSize();
+        size_t i = 0;
+        for (; i + 8 <= row_bytes; i += 8) {
+            uint64_t word;
+            memcpy(&word, row + i, 8);
+            hash = mix64(hash ^ word);
+        }
+        if (i < row_bytes) {
+            // 行尾不足8字节：补零后在最高字节记录长度
+            uint64_t word = 0;
+            memcpy(&word, row + i, row_bytes - i);
+            hash = mix64(hash ^ word ^ (static_cast<uint64_t>(row_bytes - i) << 56));
+        }
+    }
+    return hash;
+}
+
+// 匹配缓存键：截图区域内容 + 模板内容 + 区域位置
+struct MatchCacheKey {
+    uint64_t frame_hash;
+    uint64_t template_id;
+    int roi_x, roi_y, roi_w, roi_h;
+
+    bool operator==(const MatchCacheKey& other) const {
+        return frame_hash == other.frame_hash && template_id == other.template_id &&
+               roi_x == other.roi_x && roi_y == other.roi_y &&
+               roi_w == other.roi_w && roi_h == other.roi_h;
+    }
+};
+
+struct MatchCacheKeyHash {
+    size_t operator()(const MatchCacheKey& key) const {
+        uint64_t roi = (static_cast<uint64_t>(key.roi_x) << 48) ^ (static_cast<uint64_t>(key.roi_y) << 32) ^
+                       (static_cast<uint64_t>(key.roi_w) << 16) ^ static_cast<uint64_t>(key.roi_h);
+        return static_cast<size_t>(mix64(key.frame_hash ^ mix64(key.template_id ^ mix64(roi))));
+    }
+};
+
+struct MatchCacheEntry {
+    double min_val;
+    cv::Point min_loc;
+};
+
+/**
+ * 匹配结果LRU缓存
+ * 失效规则：
+ *   1. 键由截图区域和模板的64位内容哈希组成，画面或模板变化后不会命中旧结果（偶然碰撞概率约 2^-64）
+ *   2. 超出容量时淘汰最久未使用的条目
+ *   3. 匹配方法或截图分辨率等影响结果的参数变化时调用 clear() 整体清空
+ */
+class MatchCache {
+public:
+    explicit MatchCache(size_t capacity)
+        : capacity_(capacity), hits_(0), misses_(0), evictions_(0) {}
+
+    // 命中计数可被控制线程读取
+    unsigned long hits() const { return hits_.load(std::memory_order_relaxed); }
+    unsigned long misses() const { return misses_.load(std::memory_order_relaxed); }
+
+    bool lookup(const MatchCacheKey& key, MatchCacheEntry* out) {
+        Index::iterator it = index_.find(key);
+        if (it == index_.end()) {
+            misses_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        // 移到链表头部，标记为最近使用
+        entries_.splice(entries_.begin(), entries_, it->second);
+        *out = it->second->second;
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void insert(const MatchCacheKey& key, const MatchCacheEntry& entry) {
+        if (capacity_ == 0) return;
+        Index::iterator it = index_.find(key);
+        if (it != index_.end()) {
+            it->second->second = entry;
+            entries_.splice(entries_.begin(), entries_, it->second);
+            return;
+        }
+        if (entries_.size() >= capacity_) {
+            index_.erase(entries_.back().first);
+            entries_.pop_back();
+            evictions_++;
+        }
+        entries_.push_front(std::make_pair(key, entry));
+        index_[key] = entries_.begin();
+    }
+
+    void clear() {
+        entries_.clear();
+        index_.clear();
+    }
+
+    void print_stats() const {
+        unsigned long hits = this->hits();
+        unsigned long total = hits + misses();
+        printf("匹配缓存：命中 %lu / 查询 %lu（命中率 %.1f%%），淘汰 %lu，当前条目 %lu/%lu\n",
+               hits, total, total ? 100.0 * hits / total : 0.0, evictions_,
+               static_cast<unsigned long>(entries_.size()),
+               static_cast<unsigned long>(capacity_));
+    }
+
+private:
+    typedef std::list<std::pair<MatchCacheKey, MatchCacheEntry> > EntryList;
+    typedef std::unordered_map<MatchCacheKey, EntryList::iterator, MatchCacheKeyHash> Index;
+
+    size_t capacity_;
+    EntryList entries_;
+    Index index_;
+    std::atomic<unsigned long> hits_;
+    std::atomic<unsigned long> misses_;
+    unsigned long evictions_;
+};
+
+// 模板匹配时使用的图像表示
+enum MatchMode {
+    MODE_BGR = 0,     // 完整三通道
+    MODE_CHANNEL = 1  // 区分度最高的单通道
+};
+
+// 已按设备分辨率缩放的模板
+struct TemplateEntry {
+    cv::Mat image;       // 匹配用表示（已裁剪到掩码外接矩形）
+    cv::Mat mask;        // 为空表示全部像素参与匹配
+    MatchMode mode;
+    int channel;         // MODE_CHANNEL 时使用的通道
+    cv::Point offset;    // 裁剪区域相对原模板左上角的偏移
+    cv::Size full_size;  // 裁剪前的模板尺寸，用于计算中心坐标
+    uint64_t id;         // 模板内容哈希，作为匹配缓存键的一部分
+};
+
+/**
+ * 把截图区域转换为与模板一致的匹配表示
+ * @param frame 截图区域（BGR）
+ * @param model 模板
+ * @return 转换后的图像
+ */
+inline cv::Mat to_match_repr(const cv::Mat& frame, const TemplateEntry& model) {
+    cv::Mat out;
+    if (model.mode == MODE_CHANNEL) {
+        cv::extractChannel(frame, out, model.channel);
+    } else {
+        out = frame;
+    }
+    return out;
+}
+
+/**
+ * 读取模板的重要性掩码：优先使用掩码目录下的同名文件，否则取PNG透明通道
+ * @param mask_dir 掩码目录，为 nullptr 时只使用透明通道
+ * @param name 模板文件名
+ * @param raw 原始模板（可能带透明通道）
+ * @return 二值掩码，无可用掩码时为空
+ */
+inline cv::Mat load_template_mask(const char* mask_dir, const char* name, const cv::Mat& raw) {
+    char mask_path[256];
+    mask_path[0] = '\0';
+    if (mask_dir) snprintf(mask_path, sizeof(mask_path), "%s%s", mask_dir, name);
+
+    cv::Mat mask;
+    if (mask_dir && file_exists(mask_path)) {
+        mask = cv::imread(mask_path, cv::IMREAD_GRAYSCALE);
+        if (!mask.empty() && mask.size() != raw.size()) {
+            cv::resize(mask, mask, raw.size(), 0, 0, cv::INTER_NEAREST);
+        }
+    } else if (raw.channels() == 4) {
+        cv::extractChannel(raw, mask, 3);
+    }
+    if (mask.empty()) return mask;
+
+    cv::threshold(mask, mask, 127, 255, cv::THRESH_BINARY);
+    return mask;
+}
+
+/**
+ * 读取模板并按比例缩放，按掩码裁剪后转换为匹配表示
+ * @param template_dir 模板目录
+ * @param mask_dir 掩码目录，为 nullptr 时只使用透明通道
+ * @param name 模板文件名
+ * @param mode 匹配表示
+ * @param scale 缩放比例（设备高度 / 采集时高度）
+ * @param entry 输出模板
+ * @return 1表示成功，0表示失败
+ */
+inline int load_scaled_template(const char* template_dir, const char* mask_dir, const char* name,
+                                MatchMode mode, double scale, TemplateEntry* entry) {
+    char full_model_path[256];
+    snprintf(full_model_path, sizeof(full_model_path),
+             "%s%s", template_dir, name);
+
+    // 检查模板文件是否存在
+    if (!file_exists(full_model_path)) {
+        printf("模板文件不存在：%s\n", full_model_path);
+        return 0;
+    }
+
+    // 保留透明通道，用作掩码
+    cv::Mat raw = cv::imread(full_model_path, cv::IMREAD_UNCHANGED);
+    if (raw.empty()) {
+        printf("无法读取模板：%s\n", full_model_path);
+        return 0;
+    }
+
+    if (scale != 1.0) {
+        cv::Size scaled(cvRound(raw.cols * scale), cvRound(raw.rows * scale));
+        // 缩小用区域插值避免混叠，放大用双线性
+        int interp = scale < 1.0 ? cv::INTER_AREA : cv::INTER_LINEAR;
+        cv::resize(raw, raw, scaled, 0, 0, interp);
+    }
+
+    cv::Mat bgr;
+    if (raw.channels() == 4) {
+        cv::cvtColor(raw, bgr, cv::COLOR_BGRA2BGR);
+    } else if (raw.channels() == 1) {
+        cv::cvtColor(raw, bgr, cv::COLOR_GRAY2BGR);
+    } else {
+        bgr = raw;
+    }
+
+    // 裁剪到掩码外接矩形以缩小比较面积；剩余掩码只用于排除背景和光效干扰。
+    // 带掩码的 TM_SQDIFF_NORMED 需额外计算加权相关，单次匹配比无掩码更慢，掩码全满时不再使用
+    cv::Mat mask = load_template_mask(mask_dir, name, raw);
+    cv::Rect crop(0, 0, bgr.cols, bgr.rows);
+    if (!mask.empty()) {
+        int opaque = cv::countNonZero(mask);
+        if (opaque == 0 || opaque == mask.rows * mask.cols) {
+            mask.release();
+        } else {
+            crop = cv::boundingRect(mask);
+            mask = mask(crop).clone();
+            if (cv::countNonZero(mask) == crop.area()) mask.release();
+        }
+    }
+    bgr = bgr(crop);
+
+    entry->mode = mode;
+    entry->channel = 0;
+    entry->offset = crop.tl();
+    entry->full_size = raw.size();
+    entry->mask = mask;
+    if (mode == MODE_CHANNEL) {
+        // 选择掩码内标准差最大的通道，区分度最高
+        cv::Scalar mean_val, stddev;
+        cv::meanStdDev(bgr, mean_val, stddev, mask);
+        for (int c = 1; c < 3; c++) {
+            if (stddev[c] > stddev[entry->channel]) entry->channel = c;
+        }
+    }
+    entry->image = to_match_repr(bgr, *entry).clone();
+
+    uint64_t id = hash_mat_region(entry->image, cv::Rect(0, 0, entry->image.cols, entry->image.rows));
+    if (!entry->mask.empty()) {
+        id = mix64(id ^ hash_mat_region(entry->mask, cv::Rect(0, 0, entry->mask.cols, entry->mask.rows)));
+    }
+    entry->id = id;
+    return 1;
+}
+
+/**
+ * 在截图指定区域内匹配模板，画面与模板未变化时直接复用缓存结果
+ * @param img 截图
+ * @param roi 匹配区域
+ * @param model 模板
+ * @param cache 匹配缓存，为 nullptr 时每次都重新匹配
+ * @param min_val 输出最小匹配值
+ * @param min_loc 输出最佳匹配位置（截图坐标系，对应裁剪后的模板）
+ */
+inline void match_in_roi(const cv::Mat& img, const cv::Rect& roi, const TemplateEntry& model,
+                         MatchCache* cache, double* min_val, cv::Point* min_loc) {
+    MatchCacheKey key;
+    MatchCacheEntry entry;
+    if (cache) {
+        key.frame_hash = hash_mat_region(img, roi);
+        key.template_id = model.id;
+        key.roi_x = roi.x;
+        key.roi_y = roi.y;
+        key.roi_w = roi.width;
+        key.roi_h = roi.height;
+        if (cache->lookup(key, &entry)) {
+            *min_val = entry.min_val;
+            *min_loc = entry.min_loc;
+            return;
+        }
+    }
+
+    // 帧只在缓存未命中时才转换表示
+    cv::Mat result;
+    cv::Mat frame = to_match_repr(img(roi), model);
+    if (model.mask.empty()) {
+        cv::matchTemplate(frame, model.image, result, cv::TM_SQDIFF_NORMED);
+    } else {
+        cv::matchTemplate(frame, model.image, result, cv::TM_SQDIFF_NORMED, model.mask);
+    }
+    cv::minMaxLoc(result, min_val, nullptr, min_loc, nullptr);
+    *min_loc = *min_loc + roi.tl();
+
+    if (cache) {
+        entry.min_val = *min_val;
+        entry.min_loc = *min_loc;
+        cache->insert(key, entry);
+    }
+}
+
+#endif